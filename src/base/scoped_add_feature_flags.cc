@@ -6,35 +6,46 @@
 
 #include "base/base_switches.h"
 #include "base/command_line.h"
-#include "base/containers/contains.h"
 #include "base/strings/strcat.h"
 #include "base/strings/string_util.h"
 
 namespace base {
 
-ScopedAddFeatureFlags::ScopedAddFeatureFlags(CommandLine* command_line)
-    : command_line_(command_line) {
-  std::string enabled_features =
-      command_line->GetSwitchValueASCII(switches::kEnableFeatures);
-  std::string disabled_features =
-      command_line->GetSwitchValueASCII(switches::kDisableFeatures);
-  for (const StringPiece& feature :
-       FeatureList::SplitFeatureListString(enabled_features)) {
-    enabled_features_.emplace_back(feature);
-  }
-  for (const StringPiece& feature :
-       FeatureList::SplitFeatureListString(disabled_features)) {
-    disabled_features_.emplace_back(feature);
+namespace {
+
+// Returns true if the comma-separated feature |list| contains an entry equal
+// to |feature_name|.
+bool FeatureListContains(const std::string& list, StringPiece feature_name) {
+  for (const StringPiece& feature : FeatureList::SplitFeatureListString(list)) {
+    if (feature == feature_name)
+      return true;
   }
+  return false;
+}
+
+// Appends |feature_name| to the comma-separated feature |list|.
+void AppendToFeatureList(std::string* list, StringPiece feature_name) {
+  if (!list->empty())
+    list->push_back(',');
+  list->append(feature_name.data(), feature_name.size());
 }
 
+}  // namespace
+
+ScopedAddFeatureFlags::ScopedAddFeatureFlags(CommandLine* command_line)
+    : command_line_(command_line),
+      enabled_features_(
+          command_line->GetSwitchValueASCII(switches::kEnableFeatures)),
+      disabled_features_(
+          command_line->GetSwitchValueASCII(switches::kDisableFeatures)) {}
+
 ScopedAddFeatureFlags::~ScopedAddFeatureFlags() {
   command_line_->RemoveSwitch(switches::kEnableFeatures);
   command_line_->AppendSwitchASCII(switches::kEnableFeatures,
-                                   JoinString(enabled_features_, ","));
+                                   enabled_features_);
   command_line_->RemoveSwitch(switches::kDisableFeatures);
   command_line_->AppendSwitchASCII(switches::kDisableFeatures,
-                                   JoinString(disabled_features_, ","));
+                                   disabled_features_);
 }
 
 void ScopedAddFeatureFlags::EnableIfNotSet(const Feature& feature) {
@@ -65,9 +76,9 @@ bool ScopedAddFeatureFlags::IsEnabledWithParameter(
   if (!parameter_name.empty()) {
     StrAppend(&feature_name, {":", parameter_name, "/", parameter_value});
   }
-  if (Contains(disabled_features_, feature_name))
+  if (FeatureListContains(disabled_features_, feature_name))
     return false;
-  if (Contains(enabled_features_, feature_name))
+  if (FeatureListContains(enabled_features_, feature_name))
     return true;
   return feature.default_state == FEATURE_ENABLED_BY_DEFAULT;
 }
@@ -76,15 +87,12 @@ void ScopedAddFeatureFlags::AddFeatureIfNotSet(const Feature& feature,
                                                StringPiece suffix,
                                                bool enable) {
   std::string feature_name = StrCat({feature.name, suffix});
-  if (Contains(enabled_features_, feature_name) ||
-      Contains(disabled_features_, feature_name)) {
+  if (FeatureListContains(enabled_features_, feature_name) ||
+      FeatureListContains(disabled_features_, feature_name)) {
     return;
   }
-  if (enable) {
-    enabled_features_.emplace_back(feature_name);
-  } else {
-    disabled_features_.emplace_back(feature_name);
-  }
+  AppendToFeatureList(enable ? &enabled_features_ : &disabled_features_,
+                      feature_name);
 }
 
 }  // namespace base
@@ -6,7 +6,6 @@
 #define BASE_SCOPED_ADD_FEATURE_FLAGS_H_
 
 #include <string>
-#include <vector>
 
 #include "base/base_export.h"
 #include "base/feature_list.h"
@@ -53,8 +52,13 @@ class BASE_EXPORT ScopedAddFeatureFlags {
                           bool enable);
 
   const raw_ptr<CommandLine> command_line_;
-  std::vector<std::string> enabled_features_;
-  std::vector<std::string> disabled_features_;
+
+  // Comma-separated feature lists, in the same format as the
+  // --enable-features/--disable-features switch values they are built from
+  // and written back to. Keeping them as single buffers avoids a string
+  // allocation per feature and the final join on destruction.
+  std::string enabled_features_;
+  std::string disabled_features_;
 };
 
 }  // namespace base
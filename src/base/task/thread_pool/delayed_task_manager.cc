@@ -5,10 +5,13 @@
 #include "base/task/thread_pool/delayed_task_manager.h"
 
 #include <algorithm>
+#include <utility>
 
 #include "base/bind.h"
 #include "base/check.h"
+#include "base/check_op.h"
 #include "base/feature_list.h"
+#include "base/numerics/safe_conversions.h"
 #include "base/task/sequenced_task_runner.h"
 #include "base/task/task_features.h"
 #include "base/task/task_runner.h"
@@ -20,13 +23,14 @@ namespace internal {
 
 DelayedTaskManager::DelayedTask::DelayedTask() = default;
 
-DelayedTaskManager::DelayedTask::DelayedTask(
-    Task task,
-    PostTaskNowCallback callback,
-    scoped_refptr<TaskRunner> task_runner)
+DelayedTaskManager::DelayedTask::DelayedTask(Task task,
+                                             PostTaskNowCallback callback,
+                                             TaskRunnerId task_runner_id)
     : task(std::move(task)),
       callback(std::move(callback)),
-      task_runner(std::move(task_runner)) {}
+      task_runner_id(task_runner_id) {
+  is_high_res = this->task.delay_policy == subtle::DelayPolicy::kPrecise;
+}
 
 DelayedTaskManager::DelayedTask::DelayedTask(
     DelayedTaskManager::DelayedTask&& other) = default;
@@ -45,6 +49,151 @@ bool DelayedTaskManager::DelayedTask::operator>(
          std::tie(other_latest_delayed_run_time, other.task.sequence_num);
 }
 
+// static
+uint64_t DelayedTaskManager::DelayedTaskMinHeap::HeapKey::MakeSortKey(
+    TimeTicks latest_delayed_run_time,
+    int sequence_num) {
+  constexpr int kSequenceNumBits = 12;
+  constexpr uint64_t kSequenceNumMask = (uint64_t{1} << kSequenceNumBits) - 1;
+  constexpr uint64_t kMaxRunTimeUs =
+      (uint64_t{1} << (64 - kSequenceNumBits)) - 1;
+  const int64_t run_time_us =
+      latest_delayed_run_time.since_origin().InMicroseconds();
+  DCHECK_GE(run_time_us, 0);
+  // TimeTicks counts from boot, so the time field must outlast machine
+  // uptime, not process lifetime: 2^52 microseconds is ~142 years, which no
+  // host reaches. DCHECK that rather than silently saturating, since clamped
+  // keys would stop ordering by deadline.
+  DCHECK_LE(static_cast<uint64_t>(run_time_us), kMaxRunTimeUs);
+  // Truncating the sequence number can only misorder two tasks due in the
+  // very same microsecond but posted more than 2^12 posts apart, which
+  // cannot meaningfully happen.
+  return (static_cast<uint64_t>(run_time_us) << kSequenceNumBits) |
+         (static_cast<uint64_t>(static_cast<uint32_t>(sequence_num)) &
+          kSequenceNumMask);
+}
+
+DelayedTaskManager::DelayedTaskMinHeap::DelayedTaskMinHeap() = default;
+
+DelayedTaskManager::DelayedTaskMinHeap::~DelayedTaskMinHeap() = default;
+
+const DelayedTaskManager::DelayedTask&
+DelayedTaskManager::DelayedTaskMinHeap::top() const {
+  DCHECK(!keys_.empty());
+  return task_slots_[keys_.front().slot];
+}
+
+bool DelayedTaskManager::DelayedTaskMinHeap::insert(DelayedTask delayed_task) {
+  HeapKey key;
+  key.sort_key = HeapKey::MakeSortKey(
+      delayed_task.task.latest_delayed_run_time(),
+      delayed_task.task.sequence_num);
+  key.earliest_delayed_run_time =
+      delayed_task.task.earliest_delayed_run_time();
+  if (free_slots_.empty()) {
+    key.slot = checked_cast<uint32_t>(task_slots_.size());
+    task_slots_.push_back(std::move(delayed_task));
+  } else {
+    key.slot = free_slots_.back();
+    free_slots_.pop_back();
+    task_slots_[key.slot] = std::move(delayed_task);
+  }
+  if (sorted_) {
+    if (keys_.size() < kMaxSortedSize) {
+      const auto position = std::upper_bound(
+          keys_.begin(), keys_.end(), key,
+          [](const HeapKey& lhs, const HeapKey& rhs) { return rhs > lhs; });
+      const bool is_new_top = position == keys_.begin();
+      keys_.insert(position, key);
+      return is_new_top;
+    }
+    // A sorted array already satisfies the heap property, so switching to
+    // heap maintenance requires no restructuring.
+    sorted_ = false;
+  }
+  keys_.push_back(key);
+  return SiftUp(keys_.size() - 1) == 0;
+}
+
+void DelayedTaskManager::DelayedTaskMinHeap::ExtractRipeTasks(
+    TimeTicks now,
+    std::vector<DelayedTask>* ripe_delayed_tasks) {
+  size_t index = 0;
+  while (index < keys_.size()) {
+    // Read the key once; it is about to be overwritten if the task is ripe.
+    const HeapKey key = keys_[index];
+    // The run time comes from the key rather than from
+    // Task::earliest_delayed_run_time(), whose leeway arithmetic would
+    // otherwise be redone for every scanned task.
+    if (key.earliest_delayed_run_time > now &&
+        task_slots_[key.slot].task.task.MaybeValid()) {
+      ++index;
+      continue;
+    }
+    const uint32_t slot = key.slot;
+    ripe_delayed_tasks->push_back(std::move(task_slots_[slot]));
+    free_slots_.push_back(slot);
+    keys_[index] = keys_.back();
+    keys_.pop_back();
+  }
+  if (ripe_delayed_tasks->empty())
+    return;
+  // The tail-compaction above destroyed the ordering. Go back to (or stay
+  // in) sorted mode if few tasks remain; otherwise restore the heap
+  // property.
+  if (keys_.size() <= kMaxSortedSize / 2) {
+    std::sort(keys_.begin(), keys_.end(),
+              [](const HeapKey& lhs, const HeapKey& rhs) { return rhs > lhs; });
+    sorted_ = true;
+  } else {
+    sorted_ = false;
+    Heapify();
+  }
+}
+
+size_t DelayedTaskManager::DelayedTaskMinHeap::SiftUp(size_t index) {
+  while (index > 0) {
+    const size_t parent = (index - 1) / kHeapArity;
+    if (!(keys_[parent] > keys_[index]))
+      break;
+    std::swap(keys_[parent], keys_[index]);
+    index = parent;
+  }
+  return index;
+}
+
+void DelayedTaskManager::DelayedTaskMinHeap::SiftDown(size_t index) {
+  for (;;) {
+    const size_t min_child = MinChild(index);
+    if (min_child == keys_.size() || !(keys_[index] > keys_[min_child]))
+      return;
+    std::swap(keys_[index], keys_[min_child]);
+    index = min_child;
+  }
+}
+
+void DelayedTaskManager::DelayedTaskMinHeap::Heapify() {
+  if (keys_.size() < 2)
+    return;
+  const size_t last_parent = (keys_.size() - 2) / kHeapArity;
+  for (size_t index = last_parent + 1; index-- > 0;)
+    SiftDown(index);
+}
+
+size_t DelayedTaskManager::DelayedTaskMinHeap::MinChild(size_t index) const {
+  const size_t first_child = kHeapArity * index + 1;
+  if (first_child >= keys_.size())
+    return keys_.size();
+  const size_t last_child =
+      std::min(first_child + kHeapArity, keys_.size()) - 1;
+  size_t min_child = first_child;
+  for (size_t child = first_child + 1; child <= last_child; ++child) {
+    if (keys_[min_child] > keys_[child])
+      min_child = child;
+  }
+  return min_child;
+}
+
 DelayedTaskManager::DelayedTaskManager(const TickClock* tick_clock)
     : process_ripe_tasks_closure_(
           BindRepeating(&DelayedTaskManager::ProcessRipeTasks,
@@ -74,11 +223,10 @@ void DelayedTaskManager::Start(
     align_wake_ups_ = FeatureList::IsEnabled(kAlignWakeUps);
     std::tie(process_ripe_tasks_time, delay_policy) =
         GetTimeAndDelayPolicyToScheduleProcessRipeTasksLockRequired();
+    scheduled_process_ripe_tasks_time_ = process_ripe_tasks_time;
   }
-  if (!process_ripe_tasks_time.is_max()) {
-    service_thread_task_runner_->PostTask(FROM_HERE,
-                                          schedule_process_ripe_tasks_closure_);
-  }
+  if (!process_ripe_tasks_time.is_max())
+    PostScheduleProcessRipeTasksIfNeeded();
 }
 
 void DelayedTaskManager::AddDelayedTask(
@@ -93,74 +241,106 @@ void DelayedTaskManager::AddDelayedTask(
   CHECK(task.task);
   TimeTicks process_ripe_tasks_time;
   subtle::DelayPolicy delay_policy;
+  const TimeTicks earliest_delayed_run_time = task.earliest_delayed_run_time();
   {
     CheckedAutoLock auto_lock(queue_lock_);
-    auto [old_process_ripe_tasks_time, old_delay_policy] =
-        GetTimeAndDelayPolicyToScheduleProcessRipeTasksLockRequired();
-    pending_high_res_task_count_ +=
-        (task.delay_policy == subtle::DelayPolicy::kPrecise);
-    delayed_task_queue_.insert(DelayedTask(std::move(task),
-                                           std::move(post_task_now_callback),
-                                           std::move(task_runner)));
+    const TaskRunnerId task_runner_id =
+        InternTaskRunnerLockRequired(std::move(task_runner));
+    DelayedTask delayed_task(
+        std::move(task), std::move(post_task_now_callback), task_runner_id);
+    // Going from 0 to 1 pending high resolution task may upgrade the delay
+    // policy of the next wake-up to kPrecise, in which case it must be
+    // rescheduled even if its time doesn't change.
+    const bool first_high_res_task =
+        delayed_task.is_high_res && pending_high_res_task_count_++ == 0;
+    const bool is_new_head =
+        delayed_task_queue_.insert(std::move(delayed_task));
     // Not started yet.
     if (service_thread_task_runner_ == nullptr)
       return;
 
+    // Fast path: the next invocation of ProcessRipeTasks() doesn't need to
+    // change if the new task didn't become the heap top (the ripest task,
+    // from which the wake-up time is derived, is unchanged), or if a wake-up
+    // is already requested at or before the earliest time at which the new
+    // task may run. GetTimeAndDelayPolicyToScheduleProcessRipeTasksLockRequired()
+    // never computes a wake-up earlier than the earliest delayed run time of
+    // the ripest task.
+    if (!first_high_res_task &&
+        (!is_new_head ||
+         earliest_delayed_run_time >= scheduled_process_ripe_tasks_time_)) {
+      return;
+    }
+
     std::tie(process_ripe_tasks_time, delay_policy) =
         GetTimeAndDelayPolicyToScheduleProcessRipeTasksLockRequired();
     // The next invocation of ProcessRipeTasks() doesn't need to change.
-    if (old_process_ripe_tasks_time == process_ripe_tasks_time &&
-        old_delay_policy == delay_policy) {
+    if (!first_high_res_task &&
+        process_ripe_tasks_time == scheduled_process_ripe_tasks_time_) {
       return;
     }
+    scheduled_process_ripe_tasks_time_ = process_ripe_tasks_time;
   }
-  if (!process_ripe_tasks_time.is_max()) {
-    service_thread_task_runner_->PostTask(FROM_HERE,
-                                          schedule_process_ripe_tasks_closure_);
-  }
+  if (!process_ripe_tasks_time.is_max())
+    PostScheduleProcessRipeTasksIfNeeded();
 }
 
 void DelayedTaskManager::ProcessRipeTasks() {
   std::vector<DelayedTask> ripe_delayed_tasks;
+  // References that keep the TaskRunners of the ripe tasks alive until their
+  // |callback| has been run, in no particular order.
+  std::vector<scoped_refptr<TaskRunner>> ripe_task_runners;
   TimeTicks process_ripe_tasks_time;
 
   {
     CheckedAutoLock auto_lock(queue_lock_);
+    ripe_delayed_tasks = std::move(ripe_delayed_tasks_scratch_);
+    ripe_task_runners = std::move(ripe_task_runners_scratch_);
     const TimeTicks now = tick_clock_->NowTicks();
     // A delayed task is ripe if it reached its delayed run time or if it is
     // canceled. If it is canceled, schedule its deletion on the correct
     // sequence now rather than in the future, to minimize CPU wake ups and save
     // power.
-    while (!delayed_task_queue_.empty() &&
-           (delayed_task_queue_.top().task.earliest_delayed_run_time() <= now ||
-            !delayed_task_queue_.top().task.task.MaybeValid())) {
-      // The const_cast on top is okay since the DelayedTask is
-      // transactionally being popped from |delayed_task_queue_| right after
-      // and the move doesn't alter the sort order.
-      ripe_delayed_tasks.push_back(
-          std::move(const_cast<DelayedTask&>(delayed_task_queue_.top())));
-      pending_high_res_task_count_ -=
-          (delayed_task_queue_.top().task.delay_policy ==
-           subtle::DelayPolicy::kPrecise);
-      DCHECK_GE(pending_high_res_task_count_, 0);
-      delayed_task_queue_.pop();
+    delayed_task_queue_.ExtractRipeTasks(now, &ripe_delayed_tasks);
+    ripe_task_runners.reserve(ripe_delayed_tasks.size());
+    for (const DelayedTask& delayed_task : ripe_delayed_tasks) {
+      ripe_task_runners.push_back(
+          TakeTaskRunnerLockRequired(delayed_task.task_runner_id));
+      pending_high_res_task_count_ -= delayed_task.is_high_res;
     }
+    DCHECK_GE(pending_high_res_task_count_, 0);
     std::tie(process_ripe_tasks_time, std::ignore) =
         GetTimeAndDelayPolicyToScheduleProcessRipeTasksLockRequired();
+    scheduled_process_ripe_tasks_time_ = process_ripe_tasks_time;
   }
   if (!process_ripe_tasks_time.is_max()) {
     if (service_thread_task_runner_->RunsTasksInCurrentSequence()) {
       ScheduleProcessRipeTasksOnServiceThread();
     } else {
       // ProcessRipeTasks may be called on another thread under tests.
-      service_thread_task_runner_->PostTask(
-          FROM_HERE, schedule_process_ripe_tasks_closure_);
+      PostScheduleProcessRipeTasksIfNeeded();
     }
   }
 
+  // The batch extraction above doesn't visit tasks in heap order; sort the
+  // (typically few) ripe tasks so that they are forwarded in the same order
+  // as if they had been popped one by one.
+  std::sort(ripe_delayed_tasks.begin(), ripe_delayed_tasks.end(),
+            [](const DelayedTask& lhs, const DelayedTask& rhs) {
+              return rhs > lhs;
+            });
   for (auto& delayed_task : ripe_delayed_tasks) {
     std::move(delayed_task.callback).Run(std::move(delayed_task.task));
   }
+
+  // Hand the buffers back for the next invocation to reuse their capacity.
+  ripe_delayed_tasks.clear();
+  ripe_task_runners.clear();
+  {
+    CheckedAutoLock auto_lock(queue_lock_);
+    ripe_delayed_tasks_scratch_ = std::move(ripe_delayed_tasks);
+    ripe_task_runners_scratch_ = std::move(ripe_task_runners);
+  }
 }
 
 absl::optional<TimeTicks> DelayedTaskManager::NextScheduledRunTime() const {
@@ -175,6 +355,48 @@ bool DelayedTaskManager::HasPendingHighResolutionTasksForTesting() const {
   return pending_high_res_task_count_;
 }
 
+DelayedTaskManager::TaskRunnerId
+DelayedTaskManager::InternTaskRunnerLockRequired(
+    scoped_refptr<TaskRunner> task_runner) {
+  queue_lock_.AssertAcquired();
+  if (!task_runner)
+    return kInvalidTaskRunnerId;
+  // Linear scan: the number of distinct TaskRunners with in-flight delayed
+  // tasks is small in practice. Remember the first vacant entry in case
+  // |task_runner| isn't interned yet.
+  size_t vacant_entry = interned_task_runners_.size();
+  for (size_t i = 0; i < interned_task_runners_.size(); ++i) {
+    InternedTaskRunner& entry = interned_task_runners_[i];
+    if (entry.task_runner == task_runner) {
+      ++entry.num_delayed_tasks;
+      return static_cast<TaskRunnerId>(i);
+    }
+    if (!entry.task_runner && vacant_entry == interned_task_runners_.size())
+      vacant_entry = i;
+  }
+  if (vacant_entry == interned_task_runners_.size()) {
+    CHECK_LT(interned_task_runners_.size(), size_t{kInvalidTaskRunnerId});
+    interned_task_runners_.emplace_back();
+  }
+  InternedTaskRunner& entry = interned_task_runners_[vacant_entry];
+  entry.task_runner = std::move(task_runner);
+  entry.num_delayed_tasks = 1;
+  return static_cast<TaskRunnerId>(vacant_entry);
+}
+
+scoped_refptr<TaskRunner> DelayedTaskManager::TakeTaskRunnerLockRequired(
+    TaskRunnerId id) {
+  queue_lock_.AssertAcquired();
+  if (id == kInvalidTaskRunnerId)
+    return nullptr;
+  DCHECK_LT(static_cast<size_t>(id), interned_task_runners_.size());
+  InternedTaskRunner& entry = interned_task_runners_[id];
+  DCHECK_GT(entry.num_delayed_tasks, 0u);
+  if (--entry.num_delayed_tasks == 0)
+    return std::move(entry.task_runner);
+  return entry.task_runner;
+}
+
 std::pair<TimeTicks, subtle::DelayPolicy> DelayedTaskManager::
     GetTimeAndDelayPolicyToScheduleProcessRipeTasksLockRequired() {
   queue_lock_.AssertAcquired();
@@ -199,15 +421,27 @@ std::pair<TimeTicks, subtle::DelayPolicy> DelayedTaskManager::
   return std::make_pair(delayed_run_time, delay_policy);
 }
 
+void DelayedTaskManager::PostScheduleProcessRipeTasksIfNeeded() {
+  if (reschedule_pending_.exchange(true, std::memory_order_acq_rel))
+    return;
+  service_thread_task_runner_->PostTask(FROM_HERE,
+                                        schedule_process_ripe_tasks_closure_);
+}
+
 void DelayedTaskManager::ScheduleProcessRipeTasksOnServiceThread() {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
 
+  // Let subsequent posts through again: the queue state read below is at
+  // least as fresh as the state seen by any post coalesced into this run.
+  reschedule_pending_.store(false, std::memory_order_release);
+
   TimeTicks process_ripe_tasks_time;
   subtle::DelayPolicy delay_policy;
   {
     CheckedAutoLock auto_lock(queue_lock_);
     std::tie(process_ripe_tasks_time, delay_policy) =
         GetTimeAndDelayPolicyToScheduleProcessRipeTasksLockRequired();
+    scheduled_process_ripe_tasks_time_ = process_ripe_tasks_time;
   }
   DCHECK(!process_ripe_tasks_time.is_null());
   if (process_ripe_tasks_time.is_max())
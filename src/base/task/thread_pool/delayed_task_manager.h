@@ -5,11 +5,15 @@
 #ifndef BASE_TASK_THREAD_POOL_DELAYED_TASK_MANAGER_H_
 #define BASE_TASK_THREAD_POOL_DELAYED_TASK_MANAGER_H_
 
-#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <limits>
+#include <vector>
 
 #include "base/base_export.h"
 #include "base/callback.h"
-#include "base/containers/intrusive_heap.h"
 #include "base/memory/ptr_util.h"
 #include "base/memory/raw_ptr.h"
 #include "base/synchronization/atomic_flag.h"
@@ -66,17 +70,19 @@ class BASE_EXPORT DelayedTaskManager {
   bool HasPendingHighResolutionTasksForTesting() const;
 
  private:
+  // Id of an entry in |interned_task_runners_|, or |kInvalidTaskRunnerId|.
+  using TaskRunnerId = uint16_t;
+
   struct DelayedTask {
     DelayedTask();
     DelayedTask(Task task,
                 PostTaskNowCallback callback,
-                scoped_refptr<TaskRunner> task_runner);
+                TaskRunnerId task_runner_id);
     DelayedTask(DelayedTask&& other);
     DelayedTask(const DelayedTask&) = delete;
     DelayedTask& operator=(const DelayedTask&) = delete;
     ~DelayedTask();
 
-    // Required by IntrusiveHeap::insert().
     DelayedTask& operator=(DelayedTask&& other);
 
     // Used for a min-heap.
@@ -84,22 +90,151 @@ class BASE_EXPORT DelayedTaskManager {
 
     Task task;
     PostTaskNowCallback callback;
-    scoped_refptr<TaskRunner> task_runner;
+
+    // Id of the interned TaskRunner that keeps the posting TaskRunner alive
+    // until the task is ripe. Storing an id rather than a scoped_refptr
+    // shrinks the task slot and keeps reference counting out of the queue
+    // data structure.
+    TaskRunnerId task_runner_id = 0;
+
+    // Whether |task| counts towards |pending_high_res_task_count_|.
+    // Evaluated once at construction so that the enqueue/dequeue bookkeeping
+    // is a plain integer add instead of an enum comparison per task.
+    bool is_high_res = false;
 
     // Mark the delayed task as scheduled. Since the sort key is
     // |task.delayed_run_time|, it does not alter sort order when it is called.
     void SetScheduled();
+  };
 
-    // Required by IntrusiveHeap.
-    void SetHeapHandle(const HeapHandle& handle) {}
-
-    // Required by IntrusiveHeap.
-    void ClearHeapHandle() {}
+  // Min-heap of DelayedTasks, ordered by (latest_delayed_run_time,
+  // sequence_num). Implemented as an implicit 4-ary heap over a flat
+  // std::vector rather than a binary heap: the tree is half as deep and the
+  // 4 children of a node are laid out contiguously, so the sift operations
+  // performed by insert() and ExtractRipeTasks() touch significantly fewer
+  // cache lines on the task-posting hot path.
+  //
+  // The heap is laid out structure-of-arrays style: the heap order is
+  // maintained over small HeapKey entries only, while the DelayedTasks
+  // themselves live in stable slots of a freelist-backed side array. Sifting
+  // therefore moves 24-byte keys instead of full DelayedTasks.
+  //
+  // While the queue is small (the common case, thread pools are idle most
+  // of the time), the keys are kept fully sorted via insertion into place
+  // instead of heap-ordered: a handful of sorted keys is L1-resident and
+  // avoids the data-dependent branches of heap sifts. A sorted ascending
+  // array satisfies the heap property, so outgrowing the threshold switches
+  // to heap maintenance without any restructuring.
+  class DelayedTaskMinHeap {
+   public:
+    DelayedTaskMinHeap();
+    DelayedTaskMinHeap(const DelayedTaskMinHeap&) = delete;
+    DelayedTaskMinHeap& operator=(const DelayedTaskMinHeap&) = delete;
+    ~DelayedTaskMinHeap();
+
+    bool empty() const { return keys_.empty(); }
+    size_t size() const { return keys_.size(); }
+
+    // Returns the DelayedTask with the earliest latest_delayed_run_time().
+    const DelayedTask& top() const;
+
+    // Inserts |delayed_task| and returns true iff it became the new top of
+    // the heap, i.e. iff the next wake-up time may have changed.
+    bool insert(DelayedTask delayed_task);
+
+    // Moves every task that is ripe at |now| (i.e. that reached its earliest
+    // delayed run time or was canceled) into |ripe_delayed_tasks| and restores
+    // the heap property over the remaining tasks. This is a single linear
+    // scan followed by an O(n) bottom-up heapify, which does less work under
+    // the queue lock than popping the k ripe tasks one by one in O(k log n).
+    void ExtractRipeTasks(TimeTicks now,
+                          std::vector<DelayedTask>* ripe_delayed_tasks);
+
+   private:
+    // Sort key of a queued DelayedTask. |slot| indexes the corresponding
+    // task in |task_slots_|.
+    struct HeapKey {
+      // Packs (latest_delayed_run_time, sequence_num) into a single word
+      // whose unsigned order matches their lexicographic order, so that
+      // every comparison during sifts and sorted insertions is one 64-bit
+      // compare. Bits [12, 64) hold the latest delayed run time in
+      // microseconds since boot (enough for ~142 years of uptime) and bits
+      // [0, 12) hold the low bits of the sequence number as a FIFO
+      // tie-breaker for tasks due in the same microsecond.
+      static uint64_t MakeSortKey(TimeTicks latest_delayed_run_time,
+                                  int sequence_num);
+
+      // Used for a min-heap.
+      bool operator>(const HeapKey& other) const {
+        return sort_key > other.sort_key;
+      }
+
+      uint64_t sort_key;
+      // Cached copy of the task's earliest_delayed_run_time(), computed once
+      // at insertion so that the ripe scan in ExtractRipeTasks() reads the
+      // key array instead of re-deriving it from each task.
+      TimeTicks earliest_delayed_run_time;
+      uint32_t slot;
+    };
+
+    // Number of children per node. With 4 children, sifting compares
+    // siblings that share a cache line instead of chasing a deeper tree.
+    static constexpr size_t kHeapArity = 4;
+
+    // Largest size at which insert() maintains |keys_| fully sorted rather
+    // than heap-ordered.
+    static constexpr size_t kMaxSortedSize = 16;
+
+    // Returns the index at which the sifted element settled.
+    size_t SiftUp(size_t index);
+    void SiftDown(size_t index);
+
+    // Restores the heap property over all of |keys_| in O(n), sifting down
+    // from the last parent to the root so that the children of a node are
+    // still cache-resident when the node itself is sifted.
+    void Heapify();
+
+    // Returns the index of the smallest child of |index|, or
+    // |keys_.size()| if |index| has no children.
+    size_t MinChild(size_t index) const;
+
+    // Keys in heap order; fully sorted while |sorted_| is true.
+    std::vector<HeapKey> keys_;
+
+    // Whether |keys_| is currently fully sorted. Cleared when the queue
+    // outgrows kMaxSortedSize; set again by ExtractRipeTasks() once the
+    // queue has shrunk enough that re-sorting it is trivial.
+    bool sorted_ = true;
+
+    // Task storage, indexed by HeapKey::slot. Slots are stable for the
+    // lifetime of their task; vacated slots are recycled through
+    // |free_slots_| so that steady-state insertions don't allocate.
+    std::vector<DelayedTask> task_slots_;
+    std::vector<uint32_t> free_slots_;
+  };
 
-    // Required by IntrusiveHeap.
-    HeapHandle GetHeapHandle() const { return HeapHandle::Invalid(); }
+  // A TaskRunner referenced by |num_delayed_tasks| queued delayed tasks.
+  // Most posting sites reuse the same handful of TaskRunners, so interning
+  // them keeps the per-task state down to a TaskRunnerId.
+  struct InternedTaskRunner {
+    scoped_refptr<TaskRunner> task_runner;
+    size_t num_delayed_tasks = 0;
   };
 
+  static constexpr TaskRunnerId kInvalidTaskRunnerId =
+      std::numeric_limits<TaskRunnerId>::max();
+
+  // Interns |task_runner| into |interned_task_runners_| and returns its id,
+  // or kInvalidTaskRunnerId if |task_runner| is null.
+  TaskRunnerId InternTaskRunnerLockRequired(
+      scoped_refptr<TaskRunner> task_runner)
+      EXCLUSIVE_LOCKS_REQUIRED(queue_lock_);
+
+  // Returns a reference to the TaskRunner interned under |id| and releases
+  // the interned reference held on behalf of one delayed task.
+  scoped_refptr<TaskRunner> TakeTaskRunnerLockRequired(TaskRunnerId id)
+      EXCLUSIVE_LOCKS_REQUIRED(queue_lock_);
+
   // Get the time at which to schedule the next |ProcessRipeTasks()| execution,
   // or TimeTicks::Max() if none needs to be scheduled (i.e. no task, or next
   // task already scheduled).
@@ -111,6 +246,11 @@ class BASE_EXPORT DelayedTaskManager {
   // the next task is ripe.
   void ScheduleProcessRipeTasksOnServiceThread();
 
+  // Posts |schedule_process_ripe_tasks_closure_| to the service thread,
+  // unless a previous post is still in flight (it will observe the current
+  // queue state when it runs).
+  void PostScheduleProcessRipeTasksIfNeeded();
+
   const RepeatingClosure process_ripe_tasks_closure_;
   const RepeatingClosure schedule_process_ripe_tasks_closure_;
 
@@ -125,12 +265,40 @@ class BASE_EXPORT DelayedTaskManager {
 
   scoped_refptr<SequencedTaskRunner> service_thread_task_runner_;
 
+  // Whether a post of |schedule_process_ripe_tasks_closure_| to the service
+  // thread is in flight. Burst posting can change the heap top many times
+  // before the service thread gets to run; this flag coalesces the resulting
+  // redundant posts into one, which re-reads the queue state when it runs.
+  std::atomic_bool reschedule_pending_{false};
+
   DelayedTaskHandle delayed_task_handle_ GUARDED_BY_CONTEXT(sequence_checker_);
 
-  IntrusiveHeap<DelayedTask, std::greater<>> delayed_task_queue_
+  DelayedTaskMinHeap delayed_task_queue_ GUARDED_BY(queue_lock_);
+
+  // TaskRunners referenced by queued delayed tasks, deduplicated. Entries
+  // whose |num_delayed_tasks| drops to zero release their reference and are
+  // reused by later interns, so the vector stays as small as the number of
+  // distinct TaskRunners with in-flight delayed tasks.
+  std::vector<InternedTaskRunner> interned_task_runners_
+      GUARDED_BY(queue_lock_);
+
+  // Scratch buffers reused across ProcessRipeTasks() invocations, so that
+  // the steady-state ripe path doesn't reallocate them on every service
+  // thread wake up. They are moved out under |queue_lock_| for the duration
+  // of a call and moved back, cleared but with their capacity intact, once
+  // the ripe tasks have been forwarded.
+  std::vector<DelayedTask> ripe_delayed_tasks_scratch_ GUARDED_BY(queue_lock_);
+  std::vector<scoped_refptr<TaskRunner>> ripe_task_runners_scratch_
       GUARDED_BY(queue_lock_);
   int pending_high_res_task_count_ GUARDED_BY(queue_lock_){0};
 
+  // The wake-up time most recently requested for |process_ripe_tasks_closure_|
+  // (TimeTicks::Max() if none). Lets AddDelayedTask() detect, without
+  // recomputing the schedule, that a newly added task is covered by the
+  // already requested wake-up.
+  TimeTicks scheduled_process_ripe_tasks_time_ GUARDED_BY(queue_lock_) =
+      TimeTicks::Max();
+
   bool align_wake_ups_ GUARDED_BY(queue_lock_) = false;
 
   SEQUENCE_CHECKER(sequence_checker_);
@@ -14,8 +14,6 @@ namespace trace_event {
 
 ConvertableToTraceFormat::~ConvertableToTraceFormat() = default;
 
-void TracedValue::AppendAsTraceFormat(std::string* out) const {}
-
 MemoryDumpProvider::~MemoryDumpProvider() = default;
 
 // static
@@ -26,39 +24,3 @@ template size_t EstimateMemoryUsage(const std::u16string&);
 
 }  // namespace trace_event
 }  // namespace base
-
-namespace perfetto {
-
-TracedDictionary TracedValue::WriteDictionary() && {
-  return TracedDictionary();
-}
-
-TracedArray TracedValue::WriteArray() && {
-  return TracedArray();
-}
-
-TracedArray TracedDictionary::AddArray(StaticString) {
-  return TracedArray();
-}
-
-TracedArray TracedDictionary::AddArray(DynamicString) {
-  return TracedArray();
-}
-
-TracedDictionary TracedDictionary::AddDictionary(StaticString) {
-  return TracedDictionary();
-}
-
-TracedDictionary TracedDictionary::AddDictionary(DynamicString) {
-  return TracedDictionary();
-}
-
-TracedArray TracedArray::AppendArray() {
-  return TracedArray();
-}
-
-TracedDictionary TracedArray::AppendDictionary() {
-  return TracedDictionary();
-}
-
-}  // namespace perfetto
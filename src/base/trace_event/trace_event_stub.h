@@ -125,7 +125,7 @@ class BASE_EXPORT TracedValue : public ConvertableToTraceFormat {
   void BeginArray() {}
   void BeginDictionary() {}
 
-  void AppendAsTraceFormat(std::string* out) const override;
+  void AppendAsTraceFormat(std::string* out) const override {}
 };
 
 class BASE_EXPORT TracedValueJSON : public TracedValue {
@@ -262,6 +262,44 @@ class BASE_EXPORT TracedArray {
 template <class T>
 BASE_EXPORT void WriteIntoTracedValue(TracedValue, T&&) {}
 
+// The trivial bodies below are defined inline, rather than in
+// trace_event_stub.cc, so that the optimizer sees them as empty at the call
+// site and can eliminate stubbed-out trace calls entirely. They are out of
+// line only because they return types that are not yet complete at their
+// point of declaration.
+
+inline TracedDictionary TracedValue::WriteDictionary() && {
+  return TracedDictionary();
+}
+
+inline TracedArray TracedValue::WriteArray() && {
+  return TracedArray();
+}
+
+inline TracedArray TracedDictionary::AddArray(StaticString) {
+  return TracedArray();
+}
+
+inline TracedArray TracedDictionary::AddArray(DynamicString) {
+  return TracedArray();
+}
+
+inline TracedDictionary TracedDictionary::AddDictionary(StaticString) {
+  return TracedDictionary();
+}
+
+inline TracedDictionary TracedDictionary::AddDictionary(DynamicString) {
+  return TracedDictionary();
+}
+
+inline TracedArray TracedArray::AppendArray() {
+  return TracedArray();
+}
+
+inline TracedDictionary TracedArray::AppendDictionary() {
+  return TracedDictionary();
+}
+
 }  // namespace perfetto
 
 #endif  // BASE_TRACE_EVENT_TRACE_EVENT_STUB_H_
@@ -8,6 +8,7 @@
 #include <windows.h>
 
 #include <string>
+#include <vector>
 
 #include "base/check.h"
 #include "base/files/file_path.h"
@@ -23,7 +24,7 @@ namespace win {
 namespace {
 
 bool AddACEToPath(const FilePath& path,
-                  const std::vector<Sid>& sids,
+                  span<const Sid> sids,
                   DWORD access_mask,
                   DWORD inheritance,
                   bool recursive,
@@ -96,7 +97,7 @@ bool AddACEToPath(const FilePath& path,
 }  // namespace
 
 bool GrantAccessToPath(const FilePath& path,
-                       const std::vector<Sid>& sids,
+                       span<const Sid> sids,
                        DWORD access_mask,
                        DWORD inheritance,
                        bool recursive) {
@@ -105,7 +106,7 @@ bool GrantAccessToPath(const FilePath& path,
 }
 
 bool DenyAccessToPath(const FilePath& path,
-                      const std::vector<Sid>& sids,
+                      span<const Sid> sids,
                       DWORD access_mask,
                       DWORD inheritance,
                       bool recursive) {
@@ -113,7 +114,7 @@ bool DenyAccessToPath(const FilePath& path,
                       DENY_ACCESS);
 }
 
-std::vector<Sid> CloneSidVector(const std::vector<Sid>& sids) {
+std::vector<Sid> CloneSidVector(span<const Sid> sids) {
   std::vector<Sid> clone;
   clone.reserve(sids.size());
   for (const Sid& sid : sids) {
@@ -123,7 +124,8 @@ std::vector<Sid> CloneSidVector(const std::vector<Sid>& sids) {
 }
 
 void AppendSidVector(std::vector<Sid>& base_sids,
-                     const std::vector<Sid>& append_sids) {
+                     span<const Sid> append_sids) {
+  base_sids.reserve(base_sids.size() + append_sids.size());
   for (const Sid& sid : append_sids) {
     base_sids.push_back(sid.Clone());
   }
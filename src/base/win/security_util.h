@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "base/base_export.h"
+#include "base/containers/span.h"
 #include "base/win/sid.h"
 #include "base/win/windows_types.h"
 
@@ -22,7 +23,7 @@ namespace win {
 // and |recursive| is true then any inheritable ACEs granted will be propagated
 // to its children.
 BASE_EXPORT bool GrantAccessToPath(const FilePath& path,
-                                   const std::vector<Sid>& sids,
+                                   span<const Sid> sids,
                                    DWORD access_mask,
                                    DWORD inheritance,
                                    bool recursive = true);
@@ -32,17 +33,17 @@ BASE_EXPORT bool GrantAccessToPath(const FilePath& path,
 // |recursive| is true then any inheritable ACEs granted will be propagated to
 // its children.
 BASE_EXPORT bool DenyAccessToPath(const FilePath& path,
-                                  const std::vector<Sid>& sids,
+                                  span<const Sid> sids,
                                   DWORD access_mask,
                                   DWORD inheritance,
                                   bool recursive = true);
 
-// Clone a vector of Sids.
-BASE_EXPORT std::vector<Sid> CloneSidVector(const std::vector<Sid>& sids);
+// Clone a list of Sids.
+BASE_EXPORT std::vector<Sid> CloneSidVector(span<const Sid> sids);
 
-// Append a vector of Sids to an existing vector.
+// Append a list of Sids to an existing vector.
 BASE_EXPORT void AppendSidVector(std::vector<Sid>& base_sids,
-                                 const std::vector<Sid>& append_sids);
+                                 span<const Sid> append_sids);
 
 }  // namespace win
 }  // namespace base
@@ -19,10 +19,13 @@ ClientCertIdentityMac::~ClientCertIdentityMac() = default;
 void ClientCertIdentityMac::AcquirePrivateKey(
     base::OnceCallback<void(scoped_refptr<SSLPrivateKey>)>
         private_key_callback) {
+  std::move(private_key_callback).Run(AcquirePrivateKeySync());
+}
+
+scoped_refptr<SSLPrivateKey> ClientCertIdentityMac::AcquirePrivateKeySync() {
   // This only adds a ref to and returns the private key from identity_ so it
   // doesn't need to run on a worker thread.
-  std::move(private_key_callback)
-      .Run(CreateSSLPrivateKeyForSecIdentity(certificate(), identity_.get()));
+  return CreateSSLPrivateKeyForSecIdentity(certificate(), identity_.get());
 }
 
 }  // namespace net
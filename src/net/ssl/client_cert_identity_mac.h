@@ -25,6 +25,12 @@ class NET_EXPORT_PRIVATE ClientCertIdentityMac : public ClientCertIdentity {
   void AcquirePrivateKey(base::OnceCallback<void(scoped_refptr<SSLPrivateKey>)>
                              private_key_callback) override;
 
+  // Returns the private key synchronously. Acquiring the key only adds a ref
+  // to the key in |identity_|, with no blocking work, so callers that know
+  // they hold a ClientCertIdentityMac can use this directly and skip the
+  // callback plumbing of AcquirePrivateKey().
+  scoped_refptr<SSLPrivateKey> AcquirePrivateKeySync();
+
  private:
   base::ScopedCFTypeRef<SecIdentityRef> identity_;
 };